@@ -30,6 +30,14 @@ void minilib_uv_fs_read_callback(uv_fs_t *req);
 void minilib_uv_fs_write_callback(uv_fs_t *req);
 void minilib_uv_write_callback(uv_write_t *req, int status);
 void minilib_uv_read_callback(uv_stream_t *stream, int64_t nread, const char* buf);
+void minilib_uv_work_callback(uv_work_t *req);
+void minilib_uv_after_work_callback(uv_work_t *req, int status);
+void minilib_uv_async_callback(uv_async_t *async, int64_t count);
+void minilib_uv_async_release_item(void* item);
+
+// in lib.c
+void minilib_uv_async_set_closing(uv_async_t *async);
+void minilib_uv_async_queue_free(uv_async_t *async);
 
 
 // ==================================
@@ -135,6 +143,9 @@ uv_handle_t* minilib_uv_handle_init(uv_handle_t* handle)
 void minilib_uv_handle_close(uv_handle_t* handle)
 {
     LOG_DEBUG(("minilib_uv_handle_close handle=%p\n", handle));
+    if (handle->type == UV_ASYNC) {
+        minilib_uv_async_set_closing((uv_async_t*) handle);
+    }
     if (!uv_is_closing(handle)) {
         // まだクローズされていなければ、クローズ後に解放する
         uv_close(handle, minilib_uv_handle_close_callback);
@@ -158,6 +169,9 @@ void minilib_uv_handle_dealloc(uv_handle_t* handle)
         assert(uv_is_closing(handle));
         assert(!uv_is_active(handle));
         //assert(!uv_has_ref(handle));
+        if (handle->type == UV_ASYNC) {
+            minilib_uv_async_queue_free((uv_async_t*) handle);
+        }
         minilib_uv_handledata_t* data = handle->data;
         handle->data = NULL;
         LOG_DEBUG(("freeing handle=%p\n", handle));
@@ -560,3 +574,181 @@ int minilib_uv_make_pipe_pair(uv_file fds[2])
 {
     return uv_pipe(fds, UV_NONBLOCK_PIPE, UV_NONBLOCK_PIPE);
 }
+
+// ----------------------------------
+// uv_work_t
+// ----------------------------------
+
+uv_work_t* minilib_uv_work_init()
+{
+    return (uv_work_t*) minilib_uv_req_init(sizeof(uv_work_t), NULL);
+}
+
+// Called on a worker thread of the threadpool.
+void minilib_uv_work_cb(uv_work_t *req)
+{
+    LOG_DEBUG(("minilib_uv_work_cb req=%p\n", req));
+    minilib_uv_work_callback(req);
+}
+
+// Called on the loop thread after the work is done or cancelled.
+void minilib_uv_after_work_cb(uv_work_t *req, int status)
+{
+    LOG_DEBUG(("minilib_uv_after_work_cb req=%p status=%d\n", req, status));
+    minilib_uv_after_work_callback(req, status);
+}
+
+int minilib_uv_queue_work(uv_loop_t *loop, uv_work_t *req)
+{
+    LOG_DEBUG(("minilib_uv_queue_work loop=%p req=%p\n", loop, req));
+    return uv_queue_work(loop, req, minilib_uv_work_cb, minilib_uv_after_work_cb);
+}
+
+// ----------------------------------
+// uv_async_t
+// ----------------------------------
+
+// The items posted to an async handle.
+// `pending` is appended by any thread, and guarded by `mutex`.
+// `ready` is accessed only on the loop thread.
+// In the async callback, `pending` and `ready` are swapped, so that all items posted before
+// the wakeup are processed in one callback.
+struct minilib_uv_async_queue_s {
+    uv_mutex_t mutex;
+    int closing;
+    void** pending;
+    size_t pending_len;
+    size_t pending_cap;
+    void** ready;
+    size_t ready_len;
+    size_t ready_pos;
+    size_t ready_cap;
+    int64_t wakeup_count;
+};
+typedef struct minilib_uv_async_queue_s minilib_uv_async_queue_t;
+
+void minilib_uv_async_cb(uv_async_t *async)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    assert(queue->ready_pos == queue->ready_len);
+
+    uv_mutex_lock(&queue->mutex);
+    void** items = queue->ready;
+    size_t cap = queue->ready_cap;
+    queue->ready = queue->pending;
+    queue->ready_len = queue->pending_len;
+    queue->ready_cap = queue->pending_cap;
+    queue->ready_pos = 0;
+    queue->pending = items;
+    queue->pending_len = 0;
+    queue->pending_cap = cap;
+    uv_mutex_unlock(&queue->mutex);
+
+    queue->wakeup_count++;
+    LOG_DEBUG(("minilib_uv_async_cb async=%p count=%lu\n", async, (uint64_t) queue->ready_len));
+    if (queue->ready_len > 0) {
+        minilib_uv_async_callback(async, (int64_t) queue->ready_len);
+    }
+}
+
+uv_async_t* minilib_uv_async_init(uv_loop_t* loop)
+{
+    uv_async_t *async = (uv_async_t*) minilib_uv_handle_init(malloc(sizeof(uv_async_t)));
+    if (async == NULL) return NULL;
+    LOG_DEBUG(("minilib_uv_async_init async=%p\n", async));
+    minilib_uv_async_queue_t* queue = calloc(1, sizeof(minilib_uv_async_queue_t));
+    if (queue == NULL || uv_mutex_init(&queue->mutex) < 0) {
+        free(queue);
+        free(((uv_handle_t*) async)->data);
+        free(async);
+        return NULL;
+    }
+    int err = uv_async_init(loop, async, minilib_uv_async_cb);
+    if (err < 0) {
+        uv_mutex_destroy(&queue->mutex);
+        free(queue);
+        free(((uv_handle_t*) async)->data);
+        free(async);
+        return NULL;
+    }
+    minilib_uv_handle_set_extra_data((uv_handle_t*) async, queue);
+    return async;
+}
+
+// Posts an item to the async handle. This function is thread-safe.
+// The loop is woken up only when the queue becomes non-empty, so the items posted
+// before the loop wakes up are processed in one callback.
+int minilib_uv_async_post(uv_async_t *async, void* item)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    uv_mutex_lock(&queue->mutex);
+    if (queue->closing) {
+        uv_mutex_unlock(&queue->mutex);
+        return UV_ECANCELED;
+    }
+    if (queue->pending_len >= queue->pending_cap) {
+        size_t cap = queue->pending_cap == 0 ? 64 : queue->pending_cap * 2;
+        void** pending = realloc(queue->pending, cap * sizeof(void*));
+        if (pending == NULL) {
+            uv_mutex_unlock(&queue->mutex);
+            return UV_ENOMEM;
+        }
+        queue->pending = pending;
+        queue->pending_cap = cap;
+    }
+    queue->pending[queue->pending_len++] = item;
+    int err = 0;
+    if (queue->pending_len == 1) {
+        // Send while the mutex is locked, because the loop may run the item and close the handle
+        // as soon as the mutex is unlocked.
+        err = uv_async_send(async);
+        if (err < 0) {
+            // the caller releases the item
+            queue->pending_len--;
+        }
+    }
+    uv_mutex_unlock(&queue->mutex);
+    return err;
+}
+
+// Pops an item which is ready. Must be called on the loop thread.
+void* minilib_uv_async_pop_ready(uv_async_t *async)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    if (queue->ready_pos >= queue->ready_len) return NULL;
+    return queue->ready[queue->ready_pos++];
+}
+
+int64_t minilib_uv_async_get_wakeup_count(uv_async_t *async)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    return queue->wakeup_count;
+}
+
+// Called when the async handle is closed. The items posted after this call are rejected.
+void minilib_uv_async_set_closing(uv_async_t *async)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    if (queue == NULL) return;
+    uv_mutex_lock(&queue->mutex);
+    queue->closing = 1;
+    uv_mutex_unlock(&queue->mutex);
+}
+
+// Releases the items which are not processed, and frees the queue.
+void minilib_uv_async_queue_free(uv_async_t *async)
+{
+    minilib_uv_async_queue_t* queue = minilib_uv_handle_get_extra_data((uv_handle_t*) async);
+    if (queue == NULL) return;
+    for (size_t i = queue->ready_pos; i < queue->ready_len; i++) {
+        minilib_uv_async_release_item(queue->ready[i]);
+    }
+    for (size_t i = 0; i < queue->pending_len; i++) {
+        minilib_uv_async_release_item(queue->pending[i]);
+    }
+    uv_mutex_destroy(&queue->mutex);
+    free(queue->ready);
+    free(queue->pending);
+    free(queue);
+    minilib_uv_handle_set_extra_data((uv_handle_t*) async, NULL);
+}
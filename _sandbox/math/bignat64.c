@@ -0,0 +1,46 @@
+// 128-bit arithmetic helpers for bignat64.fix.
+//
+// Fix does not have a 128-bit integer type, so the high half of 64x64-bit products,
+// 128/64-bit divisions and products modulo the NTT prime are calculated here.
+#include <stdint.h>
+
+typedef unsigned __int128 uint128_t;
+
+// The prime used by the number theoretic transform. p = 2^64 - 2^32 + 1.
+#define MINILIB_BIGNAT64_NTT_PRIME 0xFFFFFFFF00000001ULL
+
+// Returns the high 64 bits of `a * b`.
+uint64_t minilib_bignat64_umulh(uint64_t a, uint64_t b)
+{
+    return (uint64_t)(((uint128_t)a * b) >> 64);
+}
+
+// Returns `(hi * 2^64 + lo) / d`. `hi < d` must be satisfied.
+uint64_t minilib_bignat64_udiv128(uint64_t hi, uint64_t lo, uint64_t d)
+{
+    return (uint64_t)((((uint128_t)hi << 64) | lo) / d);
+}
+
+// Returns `a * b mod p`, where `p` is the NTT prime.
+// Since 2^64 = 2^32 - 1 and 2^96 = -1 (mod p), the product is reduced without a division.
+uint64_t minilib_bignat64_mulmod_ntt(uint64_t a, uint64_t b)
+{
+    uint128_t x = (uint128_t)a * b;
+    uint64_t lo = (uint64_t)x;
+    uint64_t hi = (uint64_t)(x >> 64);
+    uint64_t h0 = hi & 0xFFFFFFFFULL;
+    uint64_t h1 = hi >> 32;
+    uint64_t t = lo - h1;
+    if (lo < h1) {
+        t -= 0xFFFFFFFFULL;
+    }
+    uint64_t u = h0 * 0xFFFFFFFFULL;
+    uint64_t r = t + u;
+    if (r < u) {
+        r += 0xFFFFFFFFULL;
+    }
+    if (r >= MINILIB_BIGNAT64_NTT_PRIME) {
+        r -= MINILIB_BIGNAT64_NTT_PRIME;
+    }
+    return r;
+}
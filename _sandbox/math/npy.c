@@ -0,0 +1,74 @@
+// Helpers for ndarray_npy.fix.
+//
+// A `.npy` file is mapped read-only with mmap, and the elements are read directly from the mapping.
+// The element readers use memcpy, since the data in a mapping is not necessarily aligned.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Maps a file read-only, and stores the file size to `*p_size`.
+// Returns NULL and sets `errno` on error. An empty file cannot be mapped.
+void* minilib_npy_map_file(const char* path, int64_t* p_size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return NULL;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved_errno = errno;
+    close(fd);  // the mapping is kept after the file is closed
+    if (addr == MAP_FAILED) {
+        errno = saved_errno;
+        return NULL;
+    }
+    *p_size = st.st_size;
+    return addr;
+}
+
+void minilib_npy_unmap(void* addr, int64_t size)
+{
+    munmap(addr, size);
+}
+
+// Copies `size` bytes at `src + src_pos` to `dest`.
+void minilib_npy_copy(void* dest, const void* src, int64_t src_pos, int64_t size)
+{
+    memcpy(dest, (const uint8_t*)src + src_pos, size);
+}
+
+// Writes `size` bytes at `src + src_pos` to `file`. Returns 0 on success, or -1 on error.
+int64_t minilib_npy_fwrite(FILE* file, const void* src, int64_t src_pos, int64_t size)
+{
+    size_t written = fwrite((const uint8_t*)src + src_pos, 1, size, file);
+    return written == (size_t)size ? 0 : -1;
+}
+
+// Reads an element at byte position `pos` of `src`.
+#define MINILIB_NPY_LOAD(NAME, TYPE) \
+TYPE minilib_npy_load_##NAME(const void* src, int64_t pos) \
+{ \
+    TYPE value; \
+    memcpy(&value, (const uint8_t*)src + pos, sizeof(TYPE)); \
+    return value; \
+}
+
+MINILIB_NPY_LOAD(f64, double)
+MINILIB_NPY_LOAD(f32, float)
+MINILIB_NPY_LOAD(i64, int64_t)
+MINILIB_NPY_LOAD(i32, int32_t)
+MINILIB_NPY_LOAD(u8, uint8_t)
@@ -0,0 +1,141 @@
+// zlib helpers for png_stream.fix.
+//
+// The encoder compresses the image data as independent raw deflate segments, which can be
+// compressed concurrently and concatenated into one zlib stream (as pigz does).
+// The decoder inflates the zlib stream incrementally with a `z_stream` handle.
+#include <stdint.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+// Returns the upper bound of the size of a deflate segment of `size` bytes.
+// The margin is for the zlib header, the empty stored block of `Z_SYNC_FLUSH` and the trailer.
+int64_t minilib_png_deflate_bound(int64_t size)
+{
+    return (int64_t)compressBound((uLong)size) + 16;
+}
+
+// Compresses `in[in_offset .. in_offset + in_size]` as a raw deflate segment, and writes it to `out`.
+// If `last` is zero, the segment is terminated by `Z_SYNC_FLUSH`, so it ends at a byte boundary
+// without the final block, and the next segment can be concatenated to it.
+// If `last` is nonzero, the segment is terminated by `Z_FINISH`.
+// Returns the size of the segment, or -1 on error.
+int64_t minilib_png_deflate_segment(
+    const uint8_t* in, int64_t in_offset, int64_t in_size,
+    int32_t level, int32_t last,
+    uint8_t* out, int64_t out_size)
+{
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+    strm.next_in = (Bytef*)(in + in_offset);
+    strm.avail_in = (uInt)in_size;
+    strm.next_out = out;
+    strm.avail_out = (uInt)out_size;
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int ret = deflate(&strm, flush);
+    int64_t produced = out_size - strm.avail_out;
+    deflateEnd(&strm);
+    if (strm.avail_in != 0 || (last ? ret != Z_STREAM_END : ret != Z_OK)) {
+        return -1;
+    }
+    return produced;
+}
+
+// Updates the Adler-32 checksum with `buf[offset .. offset + size]`.
+uint32_t minilib_png_adler32(uint32_t adler, const uint8_t* buf, int64_t offset, int64_t size)
+{
+    return (uint32_t)adler32((uLong)adler, buf + offset, (uInt)size);
+}
+
+// Combines the Adler-32 checksums of two sequences, where `size2` is the length of the second one.
+uint32_t minilib_png_adler32_combine(uint32_t adler1, uint32_t adler2, int64_t size2)
+{
+    return (uint32_t)adler32_combine((uLong)adler1, (uLong)adler2, (z_off_t)size2);
+}
+
+// Updates the CRC-32 checksum with `buf[offset .. offset + size]`.
+uint32_t minilib_png_crc32(uint32_t crc, const uint8_t* buf, int64_t offset, int64_t size)
+{
+    return (uint32_t)crc32((uLong)crc, buf + offset, (uInt)size);
+}
+
+// Creates an inflater of a zlib stream. Returns NULL on error.
+void* minilib_png_inflate_new(void)
+{
+    z_stream* strm = (z_stream*)calloc(1, sizeof(z_stream));
+    if (strm == NULL) {
+        return NULL;
+    }
+    if (inflateInit(strm) != Z_OK) {
+        free(strm);
+        return NULL;
+    }
+    return strm;
+}
+
+// Destroys an inflater.
+void minilib_png_inflate_free(void* handle)
+{
+    z_stream* strm = (z_stream*)handle;
+    if (strm != NULL) {
+        inflateEnd(strm);
+        free(strm);
+    }
+}
+
+// Inflates `in[in_offset .. in_offset + in_size]` into `out[out_offset .. out_offset + out_size]`.
+// The number of consumed input bytes is stored to `consumed[0]`.
+// Returns the number of produced bytes, or -1 on error.
+// At the end of the stream, the rest of the input is not consumed.
+int64_t minilib_png_inflate(
+    void* handle,
+    const uint8_t* in, int64_t in_offset, int64_t in_size,
+    uint8_t* out, int64_t out_offset, int64_t out_size,
+    int64_t* consumed)
+{
+    z_stream* strm = (z_stream*)handle;
+    strm->next_in = (Bytef*)(in + in_offset);
+    strm->avail_in = (uInt)in_size;
+    strm->next_out = out + out_offset;
+    strm->avail_out = (uInt)out_size;
+    int ret = inflate(strm, Z_NO_FLUSH);
+    consumed[0] = in_size - strm->avail_in;
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+        return -1;
+    }
+    return out_size - strm->avail_out;
+}
+
+// Inflates the rest of the zlib stream after the last row, which must not produce any more data.
+// zlib verifies the Adler-32 checksum in the trailer when it reaches the end of the stream.
+// The number of consumed input bytes is stored to `consumed[0]`.
+// Returns 1 at the end of the stream, 0 if more input is needed, or -1 on error
+// (including a checksum mismatch and excess data).
+int64_t minilib_png_inflate_finish(
+    void* handle,
+    const uint8_t* in, int64_t in_offset, int64_t in_size,
+    int64_t* consumed)
+{
+    z_stream* strm = (z_stream*)handle;
+    uint8_t extra[1];
+    strm->next_in = (Bytef*)(in + in_offset);
+    strm->avail_in = (uInt)in_size;
+    strm->next_out = extra;
+    strm->avail_out = sizeof(extra);
+    int ret = inflate(strm, Z_NO_FLUSH);
+    consumed[0] = in_size - strm->avail_in;
+    if (strm->avail_out != sizeof(extra)) {
+        return -1;
+    }
+    if (ret == Z_STREAM_END) {
+        return 1;
+    }
+    if (ret == Z_OK || ret == Z_BUF_ERROR) {
+        return 0;
+    }
+    return -1;
+}
@@ -1,3 +1,4 @@
+#define _XOPEN_SOURCE 700
 #define _XOPEN_SOURCE_EXTENDED
 #include <locale.h>
 #include <wchar.h>
@@ -153,3 +154,27 @@ int minilib_ncurses_get_max_color_pairs()
 {
     return COLOR_PAIRS;
 }
+
+// Moves the cursor to (x, y), then writes a wide string within `width` columns,
+// and fills the rest of the columns with spaces.
+// Characters which do not fit within `width` columns are not written,
+// so the string never wraps to the next line.
+int minilib_ncurses_move_add_wstr_padded(WINDOW* win, int x, int y, int width, const wchar_t* wstr)
+{
+    int ret = wmove(win, y, x);
+    if (ret == ERR) { return ERR; }
+    int col = 0;
+    for (const wchar_t* p = wstr; *p != 0; p++) {
+        int w = wcwidth(*p);
+        if (w < 0) { continue; }    // skip non-printable characters
+        if (col + w > width) { break; }
+        ret = waddnwstr(win, p, 1);
+        if (ret == ERR) { return ERR; }
+        col += w;
+    }
+    for (; col < width; col++) {
+        // NOTE: writing to the lower right corner of the window fails, so the result is ignored
+        waddch(win, ' ');
+    }
+    return OK;
+}